@@ -0,0 +1,1178 @@
+// Checks of the rating engines against small fixtures with known answers.
+// Built and run by `make check`; Basic.c is compiled in with its main renamed.
+#define main basic_main
+#include "../Basic.c"
+#undef main
+#include <sched.h>
+
+static int failures = 0;
+static char scratch_directory[] = "/tmp/spl-check-XXXXXX";
+
+#define CHECK(condition) check_that((condition), #condition, __FILE__, __LINE__)
+#define CHECK_NEAR(actual, expected, tolerance) \
+    check_near((actual), (expected), (tolerance), #actual, __FILE__, __LINE__)
+
+static void check_that(int ok, const char *condition, const char *file, int line)
+{
+    if (!ok)
+    {
+        printf("%s:%d: check failed: %s\n", file, line, condition);
+        failures++;
+    }
+}
+
+static void check_near(double actual, double expected, double tolerance, const char *expression,
+                       const char *file, int line)
+{
+    if (!(fabs(actual - expected) <= tolerance))
+    {
+        printf("%s:%d: %s is %.9g, expected %.9g within %g\n", file, line, expression, actual, expected,
+               tolerance);
+        failures++;
+    }
+}
+
+// Session files are read and written in the working directory, so the checks run in a
+// scratch directory of their own that is emptied and removed at the end
+static int enter_scratch_directory(void)
+{
+    if (mkdtemp(scratch_directory) == NULL || chdir(scratch_directory) != 0)
+    {
+        printf("Cannot create a scratch directory for the checks.\n");
+        return 0;
+    }
+    return 1;
+}
+
+static void remove_scratch_directory(void)
+{
+    DIR *directory = opendir(".");
+    if (directory != NULL)
+    {
+        struct dirent *entry;
+        while ((entry = readdir(directory)) != NULL)
+        {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+            {
+                unlink(entry->d_name);
+            }
+        }
+        closedir(directory);
+    }
+    if (chdir("/") == 0)
+    {
+        rmdir(scratch_directory);
+    }
+}
+
+// A session with the named components at their initial ratings
+static void start_session(UserComparison *session, int user_id, int algorithm_choice, const char *const names[],
+                          int n)
+{
+    init_session(session);
+    session->user_id = user_id;
+    session->algorithm_choice = algorithm_choice;
+    session->timestamp = 0;
+    snprintf(session->topic, sizeof(session->topic), "topic %d", user_id);
+    strcpy(session->user_name, "check");
+    strcpy(session->share_code, "CHECK0000");
+    for (int i = 0; i < n; i++)
+    {
+        find_or_add_component(session, names[i]);
+    }
+}
+
+// A beats B 3-1, B beats C 3-1 and A beats C 4-0. With the virtual games the fit is
+// symmetric about B, so B stays at INITIAL_RATING and A * C = INITIAL_RATING^2; the
+// values come from running the MM update to its fixed point in double precision.
+static void check_bradley_terry(void)
+{
+    ComponentStore components;
+    VoteStore votes;
+    component_store_init(&components);
+    vote_store_init(&votes);
+    component_store_add(&components, "A");
+    component_store_add(&components, "B");
+    component_store_add(&components, "C");
+    vote_store_add(&votes, 0, 1, 3);
+    vote_store_add(&votes, 1, 0, 1);
+    vote_store_add(&votes, 1, 2, 3);
+    vote_store_add(&votes, 2, 1, 1);
+    vote_store_add(&votes, 0, 2, 4);
+
+    int iterations = fit_bradley_terry(&components, 3, &votes, BT_TOLERANCE, BT_MAX_ITERATIONS);
+    CHECK(iterations > 0 && iterations < BT_MAX_ITERATIONS);
+    CHECK_NEAR(components.strength[0], 4268.199137, 1e-3);
+    CHECK_NEAR(components.strength[1], 1500.0, 1e-3);
+    CHECK_NEAR(components.strength[2], 527.154410, 1e-3);
+
+    component_store_free(&components);
+    vote_store_free(&votes);
+}
+
+// The rating phase fits algorithm 4 sessions, and the all-models pass fits its
+// Bradley-Terry column, so the fixture's votes nudged in two different orders end at
+// the same strengths either way, and displaying the chart leaves them be
+static void check_bradley_terry_session(void)
+{
+    static const char *const names[3] = {"A", "B", "C"};
+    static const int games[8][2] = {{0, 1}, {0, 1}, {0, 1}, {1, 0}, {1, 2}, {1, 2}, {1, 2}, {2, 1}};
+    UserComparison forward, backward, all_models;
+    start_session(&forward, 303, 4, names, 3);
+    start_session(&backward, 304, 4, names, 3);
+    start_session(&all_models, 305, 8, names, 3);
+    for (int g = 0; g < 8; g++)
+    {
+        add_vote(&forward, games[g][0], games[g][1], 1);
+        apply_vote(&forward, games[g][0], games[g][1]);
+        add_vote(&backward, games[7 - g][0], games[7 - g][1], 1);
+        apply_vote(&backward, games[7 - g][0], games[7 - g][1]);
+        add_vote(&all_models, games[g][0], games[g][1], 1);
+    }
+    add_vote(&forward, 0, 2, 4);
+    add_vote(&backward, 0, 2, 4);
+    add_vote(&all_models, 0, 2, 4);
+    process_votes_and_update_ratings(&forward);
+    process_votes_and_update_ratings(&backward);
+    process_votes_and_update_ratings(&all_models);
+    static const double expected[3] = {4268.199137, 1500.0, 527.154410};
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK_NEAR(forward.components.strength[i], expected[i], 1e-3);
+        CHECK_NEAR(backward.components.strength[i], expected[i], 1e-3);
+        CHECK_NEAR(all_models.components.strength[i], expected[i], 1e-3);
+    }
+
+    int order[3];
+    double before = forward.components.strength[0];
+    CHECK(display_chart(&forward, 4, order, 0));
+    CHECK(forward.components.strength[0] == before && order[0] == 0 && order[2] == 2);
+    free_session(&forward);
+    free_session(&backward);
+    free_session(&all_models);
+}
+
+// File 64 components under keys drawn from 16 values, so ties are common, then refile
+// them many times. After every batch of updates the in-order walk and rank_tree_rank_of
+// must agree with a plain sort by key, best first, ties broken by the lower id.
+static void check_rank_tree(void)
+{
+    enum { COMPONENTS = 64 };
+    double keys[COMPONENTS];
+    int order[COMPONENTS];
+    int expected[COMPONENTS];
+    unsigned int state = 12345;
+    RankTree tree;
+    rank_tree_init(&tree, RANK_BY_ELO);
+    for (int i = 0; i < COMPONENTS; i++)
+    {
+        state = state * 1103515245u + 12345u;
+        keys[i] = (state >> 16) % 16;
+        CHECK(rank_tree_insert(&tree, keys[i]));
+    }
+
+    for (int round = 0; round < 50; round++)
+    {
+        for (int update = 0; update < 20; update++)
+        {
+            state = state * 1103515245u + 12345u;
+            int id = (state >> 16) % COMPONENTS;
+            state = state * 1103515245u + 12345u;
+            keys[id] = (state >> 16) % 16;
+            rank_tree_update(&tree, id, keys[id]);
+        }
+
+        for (int i = 0; i < COMPONENTS; i++)
+        {
+            int position = i;
+            while (position > 0 && (keys[expected[position - 1]] < keys[i] ||
+                                    (keys[expected[position - 1]] == keys[i] && expected[position - 1] > i)))
+            {
+                expected[position] = expected[position - 1];
+                position--;
+            }
+            expected[position] = i;
+        }
+        CHECK(rank_tree_top(&tree, order, COMPONENTS) == COMPONENTS);
+        int agree = 1;
+        for (int i = 0; i < COMPONENTS; i++)
+        {
+            agree = agree && order[i] == expected[i] && rank_tree_rank_of(&tree, expected[i]) == i + 1;
+        }
+        CHECK(agree);
+    }
+
+    CHECK(rank_tree_top(&tree, order, 3) == 3 && order[0] == expected[0] && order[2] == expected[2]);
+    rank_tree_free(&tree);
+}
+
+// Cut the journal in the middle of its third record, as a crash during an append would,
+// and reopen it: the torn record is dropped and the file ends at the last whole record.
+static void check_journal_torn_tail(void)
+{
+    VoteJournal journal;
+    CHECK(open_vote_journal(&journal, 301, 1));
+    CHECK(append_vote_journal(&journal, 0, 1, 0, 10));
+    CHECK(append_vote_journal(&journal, 1, 2, 0, 11));
+    CHECK(append_vote_journal(&journal, 2, 0, 0, 12));
+    close_vote_journal(&journal);
+
+    off_t whole = sizeof(JournalHeader) + 2 * sizeof(JournalRecord);
+    CHECK(truncate("301.journal", whole + sizeof(JournalRecord) / 2) == 0);
+    CHECK(open_vote_journal(&journal, 301, 0));
+    CHECK(journal.records == 2);
+    struct stat st;
+    CHECK(stat("301.journal", &st) == 0 && st.st_size == whole);
+
+    // Appends continue on the record boundary
+    CHECK(append_vote_journal(&journal, 0, 2, 0, 13));
+    close_vote_journal(&journal);
+    CHECK(open_vote_journal(&journal, 301, 0));
+    CHECK(journal.records == 3);
+    close_vote_journal(&journal);
+}
+
+// A checkpoint taken after three of five votes: replay must apply only the last two
+// records, not fold the first three in a second time
+static void check_journal_replay_after_checkpoint(void)
+{
+    static const char *const names[] = {"A", "B", "C"};
+    UserComparison live, restored;
+    VoteJournal journal;
+    start_session(&live, 302, 1, names, 3);
+    CHECK(open_vote_journal(&journal, 302, 1));
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(record_vote(&live, &journal, 0, 1));
+    }
+
+    start_session(&restored, 302, 1, names, 3);
+    add_vote(&restored, 0, 1, 3);
+    win_rate_pair_kernel(&restored.components, 0, 1, 3);
+    restored.journal_records = live.journal_records;
+    CHECK(restored.journal_records == 3);
+
+    CHECK(record_vote(&live, &journal, 2, 0));
+    CHECK(record_vote(&live, &journal, 2, 0));
+    close_vote_journal(&journal);
+
+    CHECK(open_vote_journal(&journal, 302, 0));
+    CHECK(replay_vote_journal(&journal, &restored) == 2);
+    CHECK(restored.journal_records == 5);
+    CHECK(vote_store_get(&restored.votes, 0, 1) == 3);
+    CHECK(vote_store_get(&restored.votes, 2, 0) == 2);
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(restored.components.wins[i] == live.components.wins[i]);
+    }
+
+    // Nothing is left to replay once the session has caught up
+    CHECK(replay_vote_journal(&journal, &restored) == 0);
+    close_vote_journal(&journal);
+    free_session(&live);
+    free_session(&restored);
+}
+
+// A journaled TrueSkill draw replays as a draw: the two components keep equal means,
+// both variances shrink, and no win lands in the vote matrix
+static void check_journal_draw_replay(void)
+{
+    static const char *const names[] = {"A", "B"};
+    UserComparison live, restored;
+    VoteJournal journal;
+    start_session(&live, 303, 5, names, 2);
+    CHECK(open_vote_journal(&journal, 303, 1));
+    CHECK(record_draw(&live, &journal, 0, 1));
+    close_vote_journal(&journal);
+
+    start_session(&restored, 303, 5, names, 2);
+    CHECK(open_vote_journal(&journal, 303, 0));
+    CHECK(replay_vote_journal(&journal, &restored) == 1);
+    close_vote_journal(&journal);
+
+    CHECK(restored.votes.num_pairs == 0);
+    CHECK_NEAR(restored.components.mu[0], INITIAL_MU, 1e-9);
+    CHECK_NEAR(restored.components.mu[1], INITIAL_MU, 1e-9);
+    CHECK(restored.components.sigma[0] < INITIAL_SIGMA);
+    CHECK_NEAR(restored.components.mu[0], live.components.mu[0], 1e-12);
+    CHECK_NEAR(restored.components.sigma[0], live.components.sigma[0], 1e-12);
+    CHECK_NEAR(restored.components.sigma[1], live.components.sigma[1], 1e-12);
+    free_session(&live);
+    free_session(&restored);
+}
+
+// Producers push numbered votes while the main thread pops. The queue drains to a
+// single vote many times along the way, so the stub is re-pushed under contention.
+enum { QUEUE_PRODUCERS = 4, QUEUE_VOTES_PER_PRODUCER = 20000 };
+
+typedef struct
+{
+    VoteQueue *queue;
+    QueuedVote *votes;
+    int producer;
+} QueueProducer;
+
+static void *queue_producer(void *arg)
+{
+    QueueProducer *producer = arg;
+    for (int i = 0; i < QUEUE_VOTES_PER_PRODUCER; i++)
+    {
+        QueuedVote *vote = &producer->votes[i];
+        snprintf(vote->topic, sizeof(vote->topic), "%d", producer->producer);
+        vote->timestamp = i;
+        vote_queue_push(producer->queue, vote);
+        if (i % 64 == 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void check_vote_queue(void)
+{
+    VoteQueue queue;
+    QueueProducer producers[QUEUE_PRODUCERS];
+    pthread_t threads[QUEUE_PRODUCERS];
+    long next[QUEUE_PRODUCERS] = {0};
+    int started = 0;
+    vote_queue_init(&queue);
+    CHECK(vote_queue_pop(&queue) == NULL);
+    for (int p = 0; p < QUEUE_PRODUCERS; p++)
+    {
+        producers[p].queue = &queue;
+        producers[p].producer = p;
+        producers[p].votes = calloc(QUEUE_VOTES_PER_PRODUCER, sizeof(QueuedVote));
+        if (producers[p].votes != NULL && pthread_create(&threads[p], NULL, queue_producer, &producers[p]) == 0)
+        {
+            started++;
+        }
+    }
+    CHECK(started == QUEUE_PRODUCERS);
+
+    long expected = (long)started * QUEUE_VOTES_PER_PRODUCER;
+    long popped = 0;
+    int in_order = 1;
+    int known = 1;
+    double deadline = monotonic_seconds() + 60.0; // A lost vote would otherwise hang the checks
+    while (popped < expected && monotonic_seconds() < deadline)
+    {
+        QueuedVote *vote = vote_queue_pop(&queue);
+        if (vote == NULL)
+        {
+            continue;
+        }
+        int p = atoi(vote->topic);
+        if (vote == &queue.stub || p < 0 || p >= started || vote != &producers[p].votes[vote->timestamp])
+        {
+            known = 0;
+            break;
+        }
+        // Each producer's votes come out once, in the order it pushed them
+        in_order = in_order && vote->timestamp == next[p];
+        next[p] = vote->timestamp + 1;
+        popped++;
+    }
+    for (int p = 0; p < started; p++)
+    {
+        pthread_join(threads[p], NULL);
+        CHECK(next[p] == QUEUE_VOTES_PER_PRODUCER);
+    }
+    CHECK(known);
+    CHECK(in_order);
+    CHECK(popped == expected);
+    CHECK(vote_queue_pop(&queue) == NULL);
+    for (int p = 0; p < QUEUE_PRODUCERS; p++)
+    {
+        free(producers[p].votes);
+    }
+}
+
+// Save a session and load it back: the loaded stores point into the mapped snapshot, so
+// check every name, pair and rating, then grow each store past the snapshot's arrays
+// and confirm that the copy they make first keeps everything that was borrowed
+static void check_snapshot_round_trip(void)
+{
+    enum { COMPONENTS = 40 };
+    UserComparison saved, loaded;
+    char name[MAX_NAME_LEN];
+    init_session(&saved);
+    saved.user_id = 501;
+    saved.algorithm_choice = 2;
+    saved.timestamp = 1700000000;
+    saved.journal_records = 7;
+    strcpy(saved.topic, "snapshots");
+    strcpy(saved.user_name, "check");
+    strcpy(saved.share_code, "SNAP00501");
+    for (int i = 0; i < COMPONENTS; i++)
+    {
+        snprintf(name, sizeof(name), "component %d", i);
+        CHECK(find_or_add_component(&saved, name) == i);
+    }
+    for (int i = 0; i < COMPONENTS; i++)
+    {
+        add_vote(&saved, i, (i * 7 + 3) % COMPONENTS, i + 1);
+        apply_vote(&saved, i, (i * 7 + 3) % COMPONENTS);
+    }
+    process_votes_and_update_ratings(&saved);
+    CHECK(save_session_snapshot("501.bin", &saved));
+
+    init_session(&loaded);
+    CHECK(load_session_snapshot("501.bin", &loaded));
+    CHECK(loaded.components.borrowed && loaded.components.names.borrowed && loaded.votes.borrowed);
+    CHECK(loaded.user_id == 501 && loaded.algorithm_choice == 2 && loaded.timestamp == saved.timestamp);
+    CHECK(loaded.journal_records == 7 && loaded.num_components == COMPONENTS);
+    CHECK(strcmp(loaded.topic, "snapshots") == 0 && strcmp(loaded.share_code, "SNAP00501") == 0);
+
+    // Grow every borrowed store: a new component, a new pair and a count on an old pair
+    int added = find_or_add_component(&loaded, "added later");
+    CHECK(added == COMPONENTS);
+    add_vote(&loaded, added, 0, 2);
+    add_vote(&loaded, 0, 3, 1);
+    CHECK(!loaded.components.borrowed && !loaded.components.names.borrowed && !loaded.votes.borrowed);
+
+    int same = 1;
+    for (int i = 0; i < COMPONENTS; i++)
+    {
+        snprintf(name, sizeof(name), "component %d", i);
+        same = same && component_store_find(&loaded.components, name) == i &&
+               strcmp(component_name(&loaded.components, i), name) == 0 &&
+               loaded.components.elo[i] == saved.components.elo[i] &&
+               loaded.components.wins[i] == saved.components.wins[i] &&
+               loaded.components.losses[i] == saved.components.losses[i] &&
+               loaded.components.strength[i] == saved.components.strength[i];
+        int loser = (i * 7 + 3) % COMPONENTS;
+        same = same && vote_store_get(&loaded.votes, i, loser) == i + 1 + (i == 0 && loser == 3);
+    }
+    CHECK(same);
+    CHECK(loaded.votes.num_pairs == saved.votes.num_pairs + 1);
+    CHECK(vote_store_get(&loaded.votes, added, 0) == 2);
+    CHECK(component_store_find(&loaded.components, "added later") == added);
+    CHECK(loaded.components.elo[added] == INITIAL_ELO);
+
+    // The file itself is untouched by changes to the private mapping
+    UserComparison reloaded;
+    init_session(&reloaded);
+    CHECK(load_session_snapshot("501.bin", &reloaded));
+    CHECK(reloaded.num_components == COMPONENTS && reloaded.votes.num_pairs == saved.votes.num_pairs);
+    free_session(&reloaded);
+    free_session(&loaded);
+    free_session(&saved);
+}
+
+// A truncated snapshot and one whose hash index names a slot past the last entry are
+// both refused rather than bound
+static void check_snapshot_rejects_damage(void)
+{
+    static const char *const names[] = {"A", "B", "C"};
+    UserComparison session;
+    start_session(&session, 502, 1, names, 3);
+    add_vote(&session, 0, 1, 2);
+    add_vote(&session, 2, 1, 1);
+    size_t size;
+    char *image = build_snapshot_image(&session, &size);
+    CHECK(image != NULL);
+    if (image == NULL)
+    {
+        free_session(&session);
+        return;
+    }
+
+    SessionSnapshot snapshot;
+    CHECK(bind_session_snapshot(image, size, &snapshot));
+    CHECK(!bind_session_snapshot(image, size - 8, &snapshot));
+    CHECK(!bind_session_snapshot(image, sizeof(SnapshotHeader) - 1, &snapshot));
+
+    int fd = open("502.bin", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0 && write(fd, image, size / 2) == (ssize_t)(size / 2));
+    close(fd);
+    UserComparison loaded;
+    init_session(&loaded);
+    CHECK(!load_session_snapshot("502.bin", &loaded));
+
+    CHECK(bind_session_snapshot(image, size, &snapshot));
+    int *name_slots = (int *)snapshot.sections[SNAPSHOT_NAME_SLOTS];
+    int *pair_slots = (int *)snapshot.sections[SNAPSHOT_PAIR_SLOTS];
+    int *winners = (int *)snapshot.sections[SNAPSHOT_WINNERS];
+    int kept = name_slots[0];
+    name_slots[0] = 4;
+    CHECK(!bind_session_snapshot(image, size, &snapshot));
+    name_slots[0] = kept;
+    CHECK(bind_session_snapshot(image, size, &snapshot));
+    kept = pair_slots[1];
+    pair_slots[1] = -1;
+    CHECK(!bind_session_snapshot(image, size, &snapshot));
+    pair_slots[1] = kept;
+    winners[1] = 3;
+    CHECK(!bind_session_snapshot(image, size, &snapshot));
+
+    free(image);
+    free_session(&loaded);
+    free_session(&session);
+}
+
+// Legacy %d.txt files as the old writers left them: the loadable layout followed by a
+// report of the same session, a report alone, files cut short inside a voting matrix
+// and an empty file. Import must take the complete layout and skip what holds none.
+static const char legacy_text[] = "601\nsports\nalice\n1600000000\n3\n2\nABC123XYZ\n"
+                                  "Red 3 1016.00 1500.00 350.00 25.00 8.33 0.00 0.00\n"
+                                  "Blue 1 992.00 1500.00 350.00 25.00 8.33 0.00 0.00\n"
+                                  "Green 0 992.00 1500.00 350.00 25.00 8.33 0.00 0.00\n"
+                                  "0 2 1 \n1 0 0 \n0 0 0 \n";
+static const char legacy_report[] = "--- User Comparison Data ---\nUser ID: 601\nTopic: sports\nUser Name: alice\n"
+                                    "Timestamp: 1600000000\nAlgorithm Choice: 2\nShare Code: ABC123XYZ\n\n"
+                                    "--- Components ---\n"
+                                    "Component 1: Red\nWins: 3, Elo: 1016.00, Rating: 1500.00, RD: 350.00, "
+                                    "Mu: 25.00, Sigma: 8.33, PageRank: 0.0000, Bayesian Score: 0.0000\n"
+                                    "Component 2: Blue\nWins: 1, Elo: 992.00, Rating: 1500.00, RD: 350.00, "
+                                    "Mu: 25.00, Sigma: 8.33, PageRank: 0.0000, Bayesian Score: 0.0000\n"
+                                    "Component 3: Green\nWins: 0, Elo: 992.00, Rating: 1500.00, RD: 350.00, "
+                                    "Mu: 25.00, Sigma: 8.33, PageRank: 0.0000, Bayesian Score: 0.0000\n\n"
+                                    "--- Voting Matrix ---\n0 2 1 \n1 0 0 \n0 0 0 \n";
+
+static void write_text_file(const char *filename, const char *first, size_t first_length, const char *second,
+                            size_t second_length)
+{
+    FILE *file = fopen(filename, "w");
+    CHECK(file != NULL);
+    if (file != NULL)
+    {
+        CHECK(fwrite(first, 1, first_length, file) == first_length);
+        CHECK(fwrite(second, 1, second_length, file) == second_length);
+        fclose(file);
+    }
+}
+
+static void check_legacy_session(const UserComparison *session, int user_id)
+{
+    CHECK(session->user_id == user_id && session->num_components == 3 && session->algorithm_choice == 2);
+    CHECK(strcmp(session->topic, "sports") == 0 && strcmp(session->share_code, "ABC123XYZ") == 0);
+    CHECK(strcmp(component_name(&session->components, 2), "Green") == 0);
+    CHECK(session->components.wins[0] == 3 && session->components.elo[1] == 992.0f);
+    CHECK(session->votes.num_pairs == 3 && vote_store_get(&session->votes, 0, 1) == 2 &&
+          vote_store_get(&session->votes, 0, 2) == 1 && vote_store_get(&session->votes, 1, 0) == 1);
+}
+
+static void check_legacy_import(void)
+{
+    size_t text_length = sizeof(legacy_text) - 1;
+    size_t report_length = sizeof(legacy_report) - 1;
+    size_t cut_text = strstr(legacy_text, "1 0 0") - legacy_text;        // Inside the first layout's matrix
+    size_t cut_report = strstr(legacy_report, "1 0 0") - legacy_report; // Inside the report's matrix
+    write_text_file("601.txt", legacy_text, text_length, legacy_report, report_length);
+    write_text_file("602.txt", legacy_text, text_length, legacy_report, cut_report);
+    write_text_file("603.txt", legacy_text, cut_text, legacy_report, report_length);
+    write_text_file("604.txt", legacy_text, cut_text, "", 0);
+    write_text_file("605.txt", "", 0, "", 0);
+
+    UserComparison session;
+    init_session(&session);
+    CHECK(load_legacy_session("601.txt", &session));
+    check_legacy_session(&session, 601);
+    free_session(&session);
+    CHECK(load_legacy_session("602.txt", &session)); // The first layout is complete
+    check_legacy_session(&session, 601);
+    free_session(&session);
+    CHECK(load_legacy_session("603.txt", &session)); // Read from the report instead
+    check_legacy_session(&session, 601);
+    free_session(&session);
+    CHECK(!load_legacy_session("604.txt", &session));
+    CHECK(!load_legacy_session("605.txt", &session));
+    free_session(&session);
+
+    CHECK(run_import_mode() == 0);
+    for (int user_id = 601; user_id <= 605; user_id++)
+    {
+        init_session(&session);
+        int stored = load_stored_session(user_id, &session);
+        CHECK(stored == (user_id <= 603));
+        if (stored)
+        {
+            check_legacy_session(&session, user_id);
+        }
+        free_session(&session);
+    }
+    close_session_store(&session_store);
+}
+
+// The ranks must sum to one and satisfy the PageRank equation, with the rank of the
+// components that never lost shared evenly by all of them
+static void check_pagerank_fixed_point(const ComponentStore *components, int n, const VoteStore *votes)
+{
+    double total = 0.0;
+    double dangling = 0.0;
+    double *expected = calloc(n, sizeof(double));
+    double *losses = calloc(n, sizeof(double));
+    CHECK(expected != NULL && losses != NULL);
+    if (expected == NULL || losses == NULL)
+    {
+        free(expected);
+        free(losses);
+        return;
+    }
+    for (int k = 0; k < votes->num_pairs; k++)
+    {
+        losses[votes->loser[k]] += votes->count[k];
+    }
+    for (int i = 0; i < n; i++)
+    {
+        total += components->pagerank[i];
+        dangling += losses[i] == 0.0 ? components->pagerank[i] : 0.0;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        expected[i] = ((1.0 - DAMPING_FACTOR) + DAMPING_FACTOR * dangling) / n;
+    }
+    for (int k = 0; k < votes->num_pairs; k++)
+    {
+        expected[votes->winner[k]] +=
+            DAMPING_FACTOR * votes->count[k] / losses[votes->loser[k]] * components->pagerank[votes->loser[k]];
+    }
+    double error = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        error += fabs(expected[i] - components->pagerank[i]);
+    }
+    CHECK_NEAR(total, 1.0, 1e-9);
+    CHECK(error < 1e-8);
+    free(expected);
+    free(losses);
+}
+
+// A beats B twice, B beats C once and A beats C once, so A never lost
+static void check_pagerank(void)
+{
+    ComponentStore components;
+    VoteStore votes;
+    component_store_init(&components);
+    vote_store_init(&votes);
+    component_store_add(&components, "A");
+    component_store_add(&components, "B");
+    component_store_add(&components, "C");
+    vote_store_add(&votes, 0, 1, 2);
+    vote_store_add(&votes, 1, 2, 1);
+    vote_store_add(&votes, 0, 2, 1);
+    int iterations = calculate_pagerank(&components, 3, &votes, PAGERANK_TOLERANCE, PAGERANK_MAX_ITERATIONS);
+    CHECK(iterations > 0 && iterations < PAGERANK_MAX_ITERATIONS);
+    check_pagerank_fixed_point(&components, 3, &votes);
+    // C passes all its rank to A and B splits its between A and C
+    CHECK(components.pagerank[0] > components.pagerank[1] && components.pagerank[1] > components.pagerank[2]);
+
+    // The same solve split over several threads, on a graph with many components that
+    // never lost; every thread count must reach the same ranks
+    enum { COMPONENTS = 2000 };
+    double reference[COMPONENTS];
+    char name[MAX_NAME_LEN];
+    component_store_free(&components);
+    vote_store_free(&votes);
+    component_store_init(&components);
+    vote_store_init(&votes);
+    for (int i = 0; i < COMPONENTS; i++)
+    {
+        snprintf(name, sizeof(name), "c%d", i);
+        component_store_add(&components, name);
+    }
+    unsigned int state = 777;
+    for (int k = 0; k < 4 * COMPONENTS; k++)
+    {
+        state = state * 1103515245u + 12345u;
+        int winner = (state >> 16) % COMPONENTS;
+        state = state * 1103515245u + 12345u;
+        int loser = (state >> 16) % (COMPONENTS / 2); // The upper half never loses
+        if (winner != loser)
+        {
+            vote_store_add(&votes, winner, loser, 1 + k % 3);
+        }
+    }
+    for (int threads = 1; threads <= 5; threads++)
+    {
+        for (int i = 0; i < COMPONENTS; i++)
+        {
+            components.pagerank[i] = 0.0; // Cold start
+        }
+        iterations = calculate_pagerank_threads(&components, COMPONENTS, &votes, PAGERANK_TOLERANCE,
+                                                PAGERANK_MAX_ITERATIONS, threads);
+        CHECK(iterations > 0 && iterations < PAGERANK_MAX_ITERATIONS);
+        check_pagerank_fixed_point(&components, COMPONENTS, &votes);
+        int same = 1;
+        for (int i = 0; i < COMPONENTS; i++)
+        {
+            if (threads == 1)
+            {
+                reference[i] = components.pagerank[i];
+            }
+            same = same && fabs(components.pagerank[i] - reference[i]) < 1e-12;
+        }
+        CHECK(same);
+    }
+    component_store_free(&components);
+    vote_store_free(&votes);
+}
+
+// Feed the same timestamped votes to a windowed session and to one rebuilt from only
+// the votes still inside the window at the end; the two must agree pair for pair.
+// apply follows the server, which rates every vote as it arrives, instead of batch
+// mode, which rates the votes once they are all in.
+enum { WINDOW_COMPONENTS = 24, WINDOW_VOTES = 3000, WINDOW_SECONDS = 200 };
+
+static void compare_window_sessions(int algorithm_choice, double half_life, int apply)
+{
+    static int winners[WINDOW_VOTES], losers[WINDOW_VOTES];
+    static time_t timestamps[WINDOW_VOTES];
+    char name[MAX_NAME_LEN];
+    UserComparison windowed, rebuilt;
+    init_session(&windowed);
+    init_session(&rebuilt);
+    windowed.algorithm_choice = rebuilt.algorithm_choice = algorithm_choice;
+    windowed.recency.window = WINDOW_SECONDS;
+    windowed.recency.half_life = rebuilt.recency.half_life = half_life;
+    for (int i = 0; i < WINDOW_COMPONENTS; i++)
+    {
+        snprintf(name, sizeof(name), "c%d", i);
+        find_or_add_component(&windowed, name);
+        find_or_add_component(&rebuilt, name);
+    }
+
+    // Mostly rising timestamps, with some votes arriving late
+    unsigned int state = 4242;
+    time_t clock = 1000;
+    int arrived = 0;
+    for (int v = 0; v < WINDOW_VOTES; v++)
+    {
+        state = state * 1103515245u + 12345u;
+        winners[v] = (state >> 16) % WINDOW_COMPONENTS;
+        state = state * 1103515245u + 12345u;
+        losers[v] = (winners[v] + 1 + (state >> 16) % (WINDOW_COMPONENTS - 1)) % WINDOW_COMPONENTS;
+        state = state * 1103515245u + 12345u;
+        clock += (state >> 16) % 3;
+        timestamps[v] = clock - ((state >> 20) % 8 == 0 ? (state >> 24) % 250 : 0);
+        int counted = add_timed_vote(&windowed, winners[v], losers[v], timestamps[v]);
+        CHECK(counted >= 0);
+        if (counted > 0 && apply)
+        {
+            apply_vote(&windowed, winners[v], losers[v]);
+        }
+        arrived += counted == 0;
+    }
+    CHECK(arrived > 0); // Some votes came too late for the window
+
+    for (int v = 0; v < WINDOW_VOTES; v++)
+    {
+        if (timestamps[v] > windowed.recency.latest - WINDOW_SECONDS)
+        {
+            CHECK(add_timed_vote(&rebuilt, winners[v], losers[v], timestamps[v]) == 1);
+            if (apply)
+            {
+                apply_vote(&rebuilt, winners[v], losers[v]);
+            }
+        }
+    }
+    // The rebuilt session's decay epoch differs, so compare counts at the newest time
+    rebuilt.recency.latest = windowed.recency.latest;
+    if (!apply)
+    {
+        aggregate_votes(&windowed);
+        aggregate_votes(&rebuilt);
+    }
+    settle_decayed_wins(&windowed);
+    settle_decayed_wins(&rebuilt);
+
+    int same = windowed.votes.num_pairs == rebuilt.votes.num_pairs;
+    for (int p = 0; p < windowed.votes.num_pairs; p++)
+    {
+        same = same && windowed.votes.count[p] > 0 &&
+               windowed.votes.count[p] ==
+                   vote_store_get(&rebuilt.votes, windowed.votes.winner[p], windowed.votes.loser[p]);
+    }
+    CHECK(same);
+    for (int i = 0; i < WINDOW_COMPONENTS; i++)
+    {
+        double tolerance = 1e-4 * (1.0 + rebuilt.components.wins[i]);
+        CHECK_NEAR(windowed.components.wins[i], rebuilt.components.wins[i], tolerance);
+        CHECK_NEAR(windowed.components.losses[i], rebuilt.components.losses[i],
+                   1e-4 * (1.0 + rebuilt.components.losses[i]));
+    }
+    free_session(&windowed);
+    free_session(&rebuilt);
+}
+
+static void check_sliding_window(void)
+{
+    compare_window_sessions(1, 0.0, 1);  // Server win rate: counts kept vote by vote
+    compare_window_sessions(4, 0.0, 0);  // Batch: counts recounted from the store
+    compare_window_sessions(7, 0.0, 1);  // Server Bayesian: no kernel, recounted too
+    compare_window_sessions(1, 90.0, 1); // Decayed counts, kept vote by vote
+}
+
+// fast_exp2 keeps its relative error below 3e-13 over the whole clamped range, and the
+// vector path of fast_exp2_batch agrees with the scalar code that handles the tail.
+// Half-integers round to different neighbours in the two paths, so they agree only to
+// within both their errors.
+static void check_fast_exp2(void)
+{
+    enum { SAMPLES = 400003 }; // Not a multiple of the vector width, so the tail runs too
+    static double x[SAMPLES], powers[SAMPLES], scores[SAMPLES];
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        x[i] = i % 2 == 0 ? -EXP2_LIMIT + 2.0 * EXP2_LIMIT * i / (SAMPLES - 1) // The clamped range
+                          : -1.0 + 2.0 * i / SAMPLES;                            // Densely around 0
+    }
+    x[0] = -0.5;
+    x[1] = 2.5;
+    x[2] = 2 * EXP2_LIMIT; // Clamped
+    fast_exp2_batch(x, powers, SAMPLES);
+    logistic_scores(x, scores, SAMPLES);
+
+    double scalar_error = 0.0, vector_error = 0.0, disagreement = 0.0, score_error = 0.0;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        double exact = exp2(fmin(x[i], EXP2_LIMIT));
+        double scalar = fast_exp2(x[i]);
+        scalar_error = fmax(scalar_error, fabs(scalar - exact) / exact);
+        vector_error = fmax(vector_error, fabs(powers[i] - exact) / exact);
+        disagreement = fmax(disagreement, fabs(powers[i] - scalar) / exact);
+        double score = 1.0 / (1.0 + exact);
+        score_error = fmax(score_error, fabs(scores[i] - score) / score);
+    }
+    CHECK(scalar_error < 3e-13);
+    CHECK(vector_error < 3e-13);
+    CHECK(disagreement < 6e-13);
+    CHECK(score_error < 3e-13);
+
+    // Away from half-integers both paths take the same steps and agree exactly
+    int same = 1;
+    for (int i = 3; i < SAMPLES; i++)
+    {
+        same = same && (x[i] - floor(x[i]) == 0.5 || powers[i] == fast_exp2(x[i]));
+    }
+    CHECK(same);
+}
+
+// v and w of a truncated standard normal against libm's erfc over the truncation points
+// that games reach. For a win v keeps a relative error below 1.4e-7, the accuracy of the
+// erfc fit; draws and w are checked to an absolute bound.
+static void check_truncated_gaussian(void)
+{
+    const double pdf_scale = 1.0 / sqrt(2 * PI);
+    const double margin = 0.5;
+    double win_v = 0.0, win_w = 0.0, draw_v = 0.0, draw_w = 0.0;
+    for (int step = -6000; step <= 6000; step++)
+    {
+        double t = step / 1000.0;
+        double lower = t, upper = INFINITY, v, w;
+        truncated_gaussian_moments(&lower, &upper, &v, &w, 1);
+        double exact_v = pdf_scale * exp(-0.5 * t * t) / (0.5 * erfc(t * sqrt(0.5)));
+        win_v = fmax(win_v, fabs(v - exact_v) / exact_v);
+        win_w = fmax(win_w, fabs(w - exact_v * (exact_v - t)));
+
+        lower = -margin - t;
+        upper = margin - t;
+        truncated_gaussian_moments(&lower, &upper, &v, &w, 1);
+        double pdf_lower = pdf_scale * exp(-0.5 * lower * lower);
+        double pdf_upper = pdf_scale * exp(-0.5 * upper * upper);
+        double mass = lower + upper > 0 ? 0.5 * (erfc(lower * sqrt(0.5)) - erfc(upper * sqrt(0.5)))
+                                        : 0.5 * (erfc(-upper * sqrt(0.5)) - erfc(-lower * sqrt(0.5)));
+        double exact_draw_v = (pdf_lower - pdf_upper) / mass;
+        double exact_draw_w = exact_draw_v * exact_draw_v + (upper * pdf_upper - lower * pdf_lower) / mass;
+        draw_v = fmax(draw_v, fabs(v - exact_draw_v));
+        draw_w = fmax(draw_w, fabs(w - exact_draw_w));
+    }
+    CHECK(win_v < 1.4e-7);
+    CHECK(win_w < 5e-6);
+    CHECK(draw_v < 1e-6);
+    CHECK(draw_w < 5e-6);
+}
+
+// The four-player free-for-all of the TrueSkill reference implementations, with the
+// default mu, sigma, beta, tau and draw probability. A two-player match must give
+// exactly the single-game update.
+static void check_trueskill_match(void)
+{
+    static const double expected_mu[4] = {33.207, 27.401, 22.599, 16.793};
+    static const double expected_sigma[4] = {6.348, 5.787, 5.787, 6.348};
+    ComponentStore components;
+    component_store_init(&components);
+    for (int i = 0; i < 6; i++)
+    {
+        char name[2] = {(char)('A' + i), '\0'};
+        component_store_add(&components, name);
+    }
+    int players[4] = {0, 1, 2, 3};
+    int team_sizes[4] = {1, 1, 1, 1};
+    int ranks[4] = {1, 2, 3, 4};
+    CHECK(update_trueskill_match(&components, players, team_sizes, ranks, 4));
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK_NEAR(components.mu[i], expected_mu[i], 1e-3);
+        CHECK_NEAR(components.sigma[i], expected_sigma[i], 1e-3);
+    }
+
+    int pair[2] = {4, 5};
+    CHECK(update_trueskill_match(&components, pair, team_sizes, ranks, 2));
+    double mu_winner = components.mu[4], mu_loser = components.mu[5];
+    double sigma_winner = components.sigma[4], sigma_loser = components.sigma[5];
+    components.mu[4] = components.mu[5] = INITIAL_MU;
+    components.sigma[4] = components.sigma[5] = INITIAL_SIGMA;
+    update_trueskill_game(&components, 4, 5, 0);
+    CHECK_NEAR(mu_winner, components.mu[4], 1e-9);
+    CHECK_NEAR(mu_loser, components.mu[5], 1e-9);
+    CHECK_NEAR(sigma_winner, components.sigma[4], 1e-9);
+    CHECK_NEAR(sigma_loser, components.sigma[5], 1e-9);
+    component_store_free(&components);
+}
+
+// Ratings of two fresh components after the given games, played one at a time in
+// proportion: wins by 0 over 1, then wins by 1 over 0, interleaved as evenly as possible
+static void play_trueskill_games(ComponentStore *components, int wins, int losses)
+{
+    components->mu[0] = components->mu[1] = INITIAL_MU;
+    components->sigma[0] = components->sigma[1] = INITIAL_SIGMA;
+    int played = 0;
+    for (int game = 1; game <= wins + losses; game++)
+    {
+        if (llround((double)game * wins / (wins + losses)) > played)
+        {
+            update_trueskill_game(components, 0, 1, 0);
+            played++;
+        }
+        else
+        {
+            update_trueskill_game(components, 1, 0, 0);
+        }
+    }
+}
+
+// Repeated games on one pair are played in runs that must land near playing every game,
+// for straight wins, for draws and for a matchup with votes both ways, and the runs for
+// 4 million wins must number in the hundreds rather than grow with the count
+static void check_trueskill_runs(void)
+{
+    static const int matchups[3][2] = {{1000, 0}, {2400, 1600}, {9000, 1000}};
+    ComponentStore components;
+    component_store_init(&components);
+    component_store_add(&components, "A");
+    component_store_add(&components, "B");
+    VoteStore votes;
+    vote_store_init(&votes);
+    for (int m = 0; m < 3; m++)
+    {
+        play_trueskill_games(&components, matchups[m][0], matchups[m][1]);
+        double mu = components.mu[0], sigma = components.sigma[0];
+        vote_store_clear(&votes);
+        vote_store_add(&votes, 0, 1, matchups[m][0]);
+        if (matchups[m][1] > 0)
+        {
+            vote_store_add(&votes, 1, 0, matchups[m][1]);
+        }
+        components.mu[0] = components.mu[1] = INITIAL_MU;
+        components.sigma[0] = components.sigma[1] = INITIAL_SIGMA;
+        CHECK(rate_trueskill_votes(&components, 2, &votes));
+        CHECK_NEAR(components.mu[0], mu, 0.05);
+        CHECK_NEAR(components.sigma[0], sigma, 0.02);
+        CHECK_NEAR(components.mu[0] + components.mu[1], 2 * INITIAL_MU, 1e-9);
+    }
+
+    // Draws from unequal means settle on the same variance as single games
+    components.mu[0] = 40.0;
+    components.mu[1] = INITIAL_MU;
+    components.sigma[0] = components.sigma[1] = INITIAL_SIGMA;
+    for (int game = 0; game < 10000; game++)
+    {
+        update_trueskill_game(&components, 0, 1, 1);
+    }
+    double mu = components.mu[0], sigma = components.sigma[0];
+    components.mu[0] = 40.0;
+    components.mu[1] = INITIAL_MU;
+    components.sigma[0] = components.sigma[1] = INITIAL_SIGMA;
+    update_trueskill_games(&components, 0, 1, 1, 10000);
+    CHECK_NEAR(components.mu[0], mu, 1e-6);
+    CHECK_NEAR(components.sigma[0], sigma, 1e-4);
+
+    components.mu[0] = components.mu[1] = INITIAL_MU;
+    components.sigma[0] = components.sigma[1] = INITIAL_SIGMA;
+    int total[2] = {4000000, 0}, count[2] = {4000000, 0};
+    double margin = trueskill_draw_margin(2);
+    int runs = 0;
+    while (count[0] > 0 && runs < 100000)
+    {
+        double lower, upper, v[2] = {0, 0}, w[2] = {0, 0};
+        double c = trueskill_game_interval(&components, 0, 1, 0, margin, &lower, &upper);
+        truncated_gaussian_moments(&lower, &upper, v, w, 1);
+        trueskill_games_update(&components, 0, 1, total, count, c, v, w);
+        runs++;
+    }
+    CHECK(count[0] == 0);
+    CHECK(runs < 2000);
+    vote_store_free(&votes);
+    component_store_free(&components);
+}
+
+// A version 1 index, which has no share code table, is rebuilt as version 2 when it is
+// opened; every record must then resolve by id, by name and by share code
+static void check_user_index_upgrade(void)
+{
+    enum { RECORDS = 5 };
+    UserIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, USER_INDEX_MAGIC, sizeof(header.magic));
+    header.version = 1;
+    header.num_slots = 16;
+    header.next_user_id = 1;
+    UserIndex old;
+    memset(&old, 0, sizeof(old));
+    old.fd = open(USER_INDEX_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(old.fd >= 0 && ftruncate(old.fd, user_index_size(16, 1)) == 0 &&
+          pwrite(old.fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header));
+    CHECK(user_index_map(&old) && old.code_slots == NULL);
+    if (old.map == NULL)
+    {
+        close_user_index(&old);
+        return;
+    }
+    for (int i = 0; i < RECORDS; i++)
+    {
+        UserIndexRecord *record = &old.records[i];
+        memset(record, 0, sizeof(*record));
+        record->user_id = 10 + i;
+        snprintf(record->user_name, sizeof(record->user_name), "%s", i % 2 == 0 ? "even" : "odd");
+        snprintf(record->share_code, sizeof(record->share_code), "OLD%06d", i);
+        user_index_link(&old, i);
+        old.header->count++;
+    }
+    old.header->next_user_id = 10 + RECORDS;
+    close_user_index(&old);
+
+    UserIndex index;
+    UserIndexRecord found[RECORDS];
+    CHECK(open_user_index(&index));
+    CHECK(index.header->version == USER_INDEX_VERSION && index.code_slots != NULL);
+    CHECK(index.header->count == RECORDS && index.header->next_user_id == 10 + RECORDS);
+    for (int i = 0; i < RECORDS; i++)
+    {
+        char code[12];
+        snprintf(code, sizeof(code), "OLD%06d", i);
+        CHECK(user_index_find_id(&index, 10 + i, &found[0]) && found[0].user_id == 10 + i);
+        CHECK(user_index_find_share_code(&index, code, &found[0]) && found[0].user_id == 10 + i);
+    }
+    CHECK(user_index_find_name(&index, "even", found, RECORDS) == 3 && found[2].user_id == 14);
+    CHECK(user_index_find_name(&index, "odd", found, RECORDS) == 2 && found[0].user_id == 11);
+    close_user_index(&index);
+    unlink(USER_INDEX_FILE);
+}
+
+// Allocate and register sessions well past the first rebuild threshold, so the index
+// is rebuilt at a larger size and renamed over the old file twice. A second handle
+// opened before the growth must follow the renames, and every record must still
+// resolve through both.
+static void check_user_index_growth(void)
+{
+    enum { SESSIONS = 3 * USER_INDEX_INITIAL_SLOTS / 2, NAMES = 7 };
+    UserIndex writer, reader;
+    CHECK(open_user_index(&writer) && open_user_index(&reader));
+    if (writer.map == NULL || reader.map == NULL)
+    {
+        close_user_index(&writer);
+        close_user_index(&reader);
+        return;
+    }
+    int user_ids[SESSIONS];
+    int allocated = 1;
+    for (int i = 0; i < SESSIONS; i++)
+    {
+        UserIndexRecord record;
+        memset(&record, 0, sizeof(record));
+        record.user_id = user_ids[i] = user_index_allocate_id(i % 2 == 0 ? &writer : &reader);
+        allocated = allocated && user_ids[i] == user_ids[0] + i;
+        snprintf(record.user_name, sizeof(record.user_name), "user%d", i % NAMES);
+        snprintf(record.share_code, sizeof(record.share_code), "C%08d", i);
+        CHECK(user_index_add(&writer, &record));
+    }
+    CHECK(allocated);
+    CHECK(writer.header->num_slots >= 4 * USER_INDEX_INITIAL_SLOTS && writer.header->count == SESSIONS);
+
+    UserIndex *handles[2] = {&writer, &reader};
+    for (int h = 0; h < 2; h++)
+    {
+        int resolved = 1;
+        for (int i = 0; i < SESSIONS; i++)
+        {
+            UserIndexRecord record;
+            char code[12];
+            snprintf(code, sizeof(code), "C%08d", i);
+            resolved = resolved && user_index_find_id(handles[h], user_ids[i], &record) &&
+                       record.user_id == user_ids[i] && user_index_find_share_code(handles[h], code, &record) &&
+                       record.user_id == user_ids[i];
+        }
+        CHECK(resolved);
+        UserIndexRecord *records = malloc(SESSIONS * sizeof(UserIndexRecord));
+        CHECK(records != NULL);
+        if (records != NULL)
+        {
+            int found = user_index_find_name(handles[h], "user3", records, SESSIONS);
+            CHECK(found == (SESSIONS - 3 + NAMES - 1) / NAMES);
+            CHECK(found > 0 && records[0].user_id == user_ids[3] &&
+                  records[found - 1].user_id == user_ids[3 + NAMES * (found - 1)]);
+            free(records);
+        }
+    }
+    CHECK(user_index_allocate_id(&reader) == user_ids[SESSIONS - 1] + 1);
+    close_user_index(&writer);
+    close_user_index(&reader);
+}
+
+// With rand() replaying the draw of a code already in the index, generate_share_code
+// must redraw rather than hand out the code a second time
+static void check_share_code_redraw(void)
+{
+    char taken[10], code[10];
+    srand(2024);
+    generate_share_code(taken);
+    UserIndexRecord record;
+    memset(&record, 0, sizeof(record));
+    record.user_id = 99999;
+    strcpy(record.user_name, "collision");
+    strcpy(record.share_code, taken);
+    CHECK(user_index_ready() && user_index_add(&user_index, &record));
+
+    srand(2024);
+    generate_share_code(code);
+    CHECK(strlen(code) == 9 && strcmp(code, taken) != 0);
+    CHECK(!user_index_find_share_code(&user_index, code, &record));
+    CHECK(user_index_find_share_code(&user_index, taken, &record) && record.user_id == 99999);
+    close_user_index(&user_index);
+}
+
+int main(void)
+{
+    if (!enter_scratch_directory())
+    {
+        return 1;
+    }
+    check_fast_exp2();
+    check_bradley_terry();
+    check_bradley_terry_session();
+    check_truncated_gaussian();
+    check_trueskill_match();
+    check_trueskill_runs();
+    check_pagerank();
+    check_rank_tree();
+    check_sliding_window();
+    check_journal_torn_tail();
+    check_journal_replay_after_checkpoint();
+    check_journal_draw_replay();
+    check_vote_queue();
+    check_snapshot_round_trip();
+    check_snapshot_rejects_damage();
+    check_legacy_import();
+    check_user_index_upgrade();
+    check_user_index_growth();
+    check_share_code_redraw();
+    remove_scratch_directory();
+    if (failures > 0)
+    {
+        printf("%d check(s) failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}